@@ -0,0 +1,337 @@
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/network/http/websocket.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/program_options.hpp>
+
+using namespace std;
+namespace bpo = boost::program_options;
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+/// Latencies and outcomes of every call to one API method
+struct method_stats
+{
+  std::vector<int64_t> micros;
+  uint64_t sent = 0;
+  uint64_t errors = 0;
+};
+
+/// Shared by all clients, updated from the worker threads as responses arrive
+class stats_collector
+{
+  public:
+    void sent( const std::string& method )
+    {
+      std::lock_guard<std::mutex> guard( _mutex );
+      _methods[method].sent++;
+    }
+
+    void completed( const std::string& method, int64_t micros, bool error )
+    {
+      std::lock_guard<std::mutex> guard( _mutex );
+      method_stats& s = _methods[method];
+      if( error )
+        s.errors++;
+      else
+        s.micros.push_back( micros );
+    }
+
+    void notice()
+    {
+      _notices++;
+    }
+
+    void connect_failed()
+    {
+      _connect_failures++;
+    }
+
+    fc::mutable_variant_object report( int64_t wall_micros )
+    {
+      std::lock_guard<std::mutex> guard( _mutex );
+      double seconds = double( wall_micros ) / 1000000.0;
+      fc::mutable_variant_object methods;
+      for( auto& entry : _methods )
+      {
+        method_stats& s = entry.second;
+        std::sort( s.micros.begin(), s.micros.end() );
+        uint64_t answered = s.micros.size() + s.errors;
+        fc::mutable_variant_object m;
+        m( "sent", s.sent )
+         ( "ok", s.micros.size() )
+         ( "errors", s.errors )
+         ( "unanswered", s.sent - answered )
+         ( "calls_per_sec", seconds > 0 ? double( s.micros.size() ) / seconds : 0.0 )
+         ( "p50_us", percentile( s.micros, 500 ) )
+         ( "p99_us", percentile( s.micros, 990 ) )
+         ( "p999_us", percentile( s.micros, 999 ) )
+         ( "max_us", s.micros.empty() ? 0 : s.micros.back() );
+        methods( entry.first, m );
+      }
+
+      fc::mutable_variant_object result;
+      result( "wall_us", wall_micros )
+            ( "connect_failures", _connect_failures.load() )
+            ( "notices", _notices.load() )
+            ( "methods", methods );
+      return result;
+    }
+
+  private:
+    /// @p per_mille is the rank in thousandths, so 999 gives p99.9
+    static int64_t percentile( const std::vector<int64_t>& sorted_micros, uint32_t per_mille )
+    {
+      if( sorted_micros.empty() )
+        return 0;
+      return sorted_micros[ ( (sorted_micros.size() - 1) * per_mille ) / 1000 ];
+    }
+
+    std::mutex                           _mutex;
+    std::map<std::string, method_stats>  _methods;
+    std::atomic<uint64_t>                _notices{0};
+    std::atomic<uint64_t>                _connect_failures{0};
+};
+
+/**
+ * One websocket connection replaying the call mix of tests/intense/api_stress.py:
+ * fetch global properties, subscribe to dynamic global properties, load a full account,
+ * then keep peeking at random accounts.
+ *
+ * Create, poll and close it on one fc::thread; replies are delivered as tasks on that thread.
+ */
+class api_client
+{
+  public:
+    api_client( stats_collector& stats, uint64_t seed, uint32_t max_account, uint32_t peek_interval_ms )
+      : _stats( stats ), _rng( seed ), _max_account( max_account ), _peek_interval_ms( peek_interval_ms )
+    {
+    }
+
+    bool connect( const std::string& server )
+    {
+      try
+      {
+        _connection = _client.connect( server );
+      }
+      catch( const fc::exception& e )
+      {
+        _stats.connect_failed();
+        dlog( "api_stress: connect failed: ${e}", ("e", e.to_string()) );
+        return false;
+      }
+      _connection->on_message_handler( [this]( const std::string& msg ) { on_message( msg ); } );
+
+      std::string my_account = "1.2." + fc::to_string( random_account() );
+      call( "get_objects", fc::variants{ fc::variant( fc::variants{ "2.0.0" } ) } );
+      call( "set_subscribe_callback", fc::variants{ 111, false } );
+      call( "get_objects", fc::variants{ fc::variant( fc::variants{ "2.1.0" } ) } );
+      call( "get_full_accounts", fc::variants{ fc::variant( fc::variants{ my_account } ), true } );
+      schedule_peek();
+      return true;
+    }
+
+    /// Sends a random account lookup if one is due; called from the client's worker thread
+    void poll( clock_type::time_point now )
+    {
+      if( !_connection || now < _next_peek )
+        return;
+      std::string account = "1.2." + fc::to_string( random_account() );
+      call( "get_objects", fc::variants{ fc::variant( fc::variants{ account } ) } );
+      schedule_peek();
+    }
+
+    void close()
+    {
+      if( _connection )
+        _client.synchronous_close();
+    }
+
+  private:
+    struct pending_call
+    {
+      std::string               method;
+      clock_type::time_point    sent;
+    };
+
+    uint32_t random_account()
+    {
+      return _rng() % _max_account;
+    }
+
+    void schedule_peek()
+    {
+      _next_peek = clock_type::now() + std::chrono::milliseconds( _rng() % ( _peek_interval_ms + 1 ) );
+    }
+
+    void call( const std::string& method, const fc::variants& args )
+    {
+      uint64_t id;
+      {
+        std::lock_guard<std::mutex> guard( _mutex );
+        id = _next_id++;
+        _pending[id] = pending_call{ method, clock_type::now() };
+      }
+      fc::mutable_variant_object request;
+      request( "id", id )
+             ( "method", "call" )
+             ( "params", fc::variants{ "database", method, args } );
+      _stats.sent( method );
+      _connection->send_message( fc::json::to_string( fc::variant( request, 3 ) ) );
+    }
+
+    void on_message( const std::string& msg )
+    {
+      auto received = clock_type::now();
+      fc::variant_object reply;
+      try
+      {
+        reply = fc::json::from_string( msg ).get_object();
+      }
+      catch( const fc::exception& e )
+      {
+        dlog( "api_stress: unparsable reply: ${e}", ("e", e.to_string()) );
+        return;
+      }
+
+      if( !reply.contains( "id" ) || reply["id"].is_null() )
+      {
+        if( reply.contains( "method" ) && reply["method"].as_string() == "notice" )
+          _stats.notice();
+        return;
+      }
+
+      pending_call call;
+      {
+        std::lock_guard<std::mutex> guard( _mutex );
+        auto itr = _pending.find( reply["id"].as_uint64() );
+        if( itr == _pending.end() )
+          return;
+        call = itr->second;
+        _pending.erase( itr );
+      }
+      int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>( received - call.sent ).count();
+      _stats.completed( call.method, micros, reply.contains( "error" ) );
+    }
+
+    stats_collector&                        _stats;
+    std::mt19937_64                         _rng;
+    uint32_t                                _max_account;
+    uint32_t                                _peek_interval_ms;
+    fc::http::websocket_client              _client;
+    fc::http::websocket_connection_ptr      _connection;
+    clock_type::time_point                  _next_peek;
+    std::mutex                              _mutex;
+    uint64_t                                _next_id = 1;
+    std::map<uint64_t, pending_call>        _pending;
+};
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+  try
+  {
+    bpo::options_description cli_options("Graphene API stress test");
+    cli_options.add_options()
+      ("help,h", "Print this help message and exit.")
+      ("server,s", bpo::value<string>()->default_value("ws://localhost:8090"), "Websocket endpoint of the node under test")
+      ("clients,c", bpo::value<uint32_t>()->default_value(200), "Number of concurrent websocket connections")
+      ("threads,t", bpo::value<uint32_t>()->default_value(std::max(1u, std::thread::hardware_concurrency())), "Threads driving the connections")
+      ("duration,d", bpo::value<uint32_t>()->default_value(60), "Seconds to run the load")
+      ("max-account", bpo::value<uint32_t>()->default_value(90000), "Account instances are picked from [0, max-account)")
+      ("peek-interval", bpo::value<uint32_t>()->default_value(3000), "Upper bound in ms between random account lookups per client")
+      ("seed", bpo::value<uint64_t>()->default_value(0), "Seed for the per-client random account choice")
+      ;
+
+  bpo::variables_map options;
+  try
+  {
+    boost::program_options::store( boost::program_options::parse_command_line(argc, argv, cli_options), options );
+  }
+  catch (const boost::program_options::error& e)
+  {
+    std::cerr << "api_stress: error parsing command line: " << e.what() << "\n";
+    return 1;
+  }
+
+  if( options.count("help") )
+  {
+    std::cout << cli_options << "\n";
+    return 0;
+  }
+
+  std::string server = options["server"].as<string>();
+  uint32_t num_clients = options["clients"].as<uint32_t>();
+  uint32_t num_threads = std::max( 1u, options["threads"].as<uint32_t>() );
+  uint32_t duration = options["duration"].as<uint32_t>();
+  uint32_t max_account = options["max-account"].as<uint32_t>();
+  uint32_t peek_interval = options["peek-interval"].as<uint32_t>();
+  uint64_t seed = options["seed"].as<uint64_t>();
+  FC_ASSERT( max_account > 0, "max-account must be positive" );
+
+  stats_collector stats;
+
+  std::cerr << "api_stress: Connecting " << num_clients << " clients to " << server << "\n";
+  auto run_start = clock_type::now();
+  auto run_end = run_start + std::chrono::seconds( duration );
+
+  // Each worker owns every num_threads-th client. The clients must be created on the worker:
+  // websocket_client hands every incoming message to the fc thread it was created on, so that
+  // thread has to keep running its scheduler, which fc::usleep does between polls.
+  std::vector<std::unique_ptr<fc::thread>> workers;
+  std::vector<fc::future<void>> done;
+  for( uint32_t t = 0; t < num_threads; ++t )
+  {
+    workers.emplace_back( new fc::thread( "api_stress_" + fc::to_string( t ) ) );
+    done.push_back( workers.back()->async( [&, t]()
+    {
+      std::vector<std::unique_ptr<api_client>> clients;
+      for( uint32_t i = t; i < num_clients; i += num_threads )
+        clients.emplace_back( new api_client( stats, seed + i, max_account, peek_interval ) );
+      for( auto& c : clients )
+        c->connect( server );
+      while( clock_type::now() < run_end )
+      {
+        auto now = clock_type::now();
+        for( auto& c : clients )
+          c->poll( now );
+        fc::usleep( fc::milliseconds(1) );
+      }
+      for( auto& c : clients )
+        c->close();
+    } ) );
+  }
+  for( auto& d : done )
+    d.wait();
+  for( auto& w : workers )
+    w->quit();
+
+  // throughput is reported over the load window, not the connect and close phases around it
+  int64_t wall_micros = std::chrono::duration_cast<std::chrono::microseconds>( run_end - run_start ).count();
+
+  std::cout << fc::json::to_string( fc::variant( stats.report( wall_micros ), 4 ) ) << "\n";
+}
+catch ( const fc::exception& e )
+{
+  std::cerr << e.to_detail_string() << "\n";
+  return 1;
+}
+return 0;
+}
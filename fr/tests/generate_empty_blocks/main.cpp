@@ -1,18 +1,29 @@
 
 #include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <random>
+#include <sstream>
 
 #include <fc/io/fstream.hpp>
 #include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
 #include <fc/io/stdio.hpp>
+#include <fc/variant_object.hpp>
 
 #include <graphene/app/api.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/balance_object.hpp>
 #include <graphene/egenesis/egenesis.hpp>
 #include <graphene/utilities/key_conversion.hpp>
 
+#include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
 
 #ifdef WIN32
 #include <csignal>
@@ -28,6 +39,557 @@ namespace graphene { namespace app { namespace detail {
 genesis_state_type create_example_genesis();
 } } }
 
+namespace {
+
+/// Wall-clock cost of producing one block, split by whether the block ran maintenance
+struct block_timing
+{
+  int64_t  micros = 0;
+  int64_t  push_micros = 0;
+  uint32_t transactions = 0;
+  bool     maintenance = false;
+};
+
+int64_t percentile( const std::vector<int64_t>& sorted_micros, uint32_t pct )
+{
+  if( sorted_micros.empty() )
+    return 0;
+  size_t idx = ( (sorted_micros.size() - 1) * pct ) / 100;
+  return sorted_micros[idx];
+}
+
+fc::mutable_variant_object summarize( const std::vector<int64_t>& micros_in )
+{
+  std::vector<int64_t> micros( micros_in );
+  std::sort( micros.begin(), micros.end() );
+  int64_t total = 0;
+  for( int64_t m : micros )
+    total += m;
+
+  fc::mutable_variant_object result;
+  result( "blocks", micros.size() )
+        ( "total_us", total )
+        ( "p50_us", percentile( micros, 50 ) )
+        ( "p99_us", percentile( micros, 99 ) )
+        ( "max_us", micros.empty() ? 0 : micros.back() );
+  return result;
+}
+
+/// Prints the benchmark report as a single JSON object on stdout, progress stays on stderr
+void print_benchmark_report( const std::vector<block_timing>& timings, int64_t wall_micros, int64_t checkpoint_micros,
+                             uint32_t missed, uint64_t rejected )
+{
+  std::vector<int64_t> all, maintenance, ordinary, push;
+  uint64_t transactions = 0;
+  all.reserve( timings.size() );
+  push.reserve( timings.size() );
+  for( const block_timing& t : timings )
+  {
+    all.push_back( t.micros );
+    push.push_back( t.push_micros );
+    transactions += t.transactions;
+    if( t.maintenance )
+      maintenance.push_back( t.micros );
+    else
+      ordinary.push_back( t.micros );
+  }
+
+  double seconds = double( wall_micros ) / 1000000.0;
+  fc::mutable_variant_object report;
+  report( "blocks", timings.size() )
+        ( "missed_slots", missed )
+        ( "wall_us", wall_micros )
+        ( "checkpoint_us", checkpoint_micros )
+        ( "blocks_per_sec", seconds > 0 ? double( timings.size() ) / seconds : 0.0 )
+        ( "transactions", transactions )
+        ( "rejected_transactions", rejected )
+        ( "tx_per_sec", seconds > 0 ? double( transactions ) / seconds : 0.0 )
+        ( "all", summarize( all ) )
+        ( "maintenance", summarize( maintenance ) )
+        ( "ordinary", summarize( ordinary ) )
+        ( "push", summarize( push ) );
+
+  std::cout << fc::json::to_string( fc::variant( report, 3 ) ) << "\n";
+}
+
+/// Relative weights of the operations pushed by the synthetic load generator
+struct load_mix
+{
+  uint32_t transfer = 100;
+  uint32_t limit_order = 0;
+  uint32_t htlc = 0;
+
+  uint32_t total()const { return transfer + limit_order + htlc; }
+};
+
+/// Parses "transfer:60,limit_order:30,htlc:10"; operations that are not listed get weight 0
+load_mix parse_load_mix( const std::string& spec )
+{
+  load_mix mix;
+  mix.transfer = 0;
+  std::vector<std::string> entries;
+  boost::split( entries, spec, boost::is_any_of(",") );
+  for( const std::string& entry : entries )
+  {
+    if( entry.empty() )
+      continue;
+    size_t colon = entry.find(':');
+    FC_ASSERT( colon != std::string::npos, "Invalid mix entry '${e}', expected name:weight", ("e",entry) );
+    std::string name = entry.substr( 0, colon );
+    uint32_t weight = 0;
+    try
+    {
+      weight = boost::lexical_cast<uint32_t>( entry.substr( colon + 1 ) );
+    }
+    catch( const boost::bad_lexical_cast& )
+    {
+      FC_THROW( "Invalid weight in mix entry '${e}', expected a non-negative integer", ("e",entry) );
+    }
+    if( name == "transfer" )
+      mix.transfer = weight;
+    else if( name == "limit_order" )
+      mix.limit_order = weight;
+    else if( name == "htlc" )
+      mix.htlc = weight;
+    else
+      FC_THROW( "Unknown operation '${n}' in mix, expected transfer, limit_order or htlc", ("n",name) );
+  }
+  FC_ASSERT( mix.total() > 0, "Operation mix must have a non-zero weight" );
+  return mix;
+}
+
+/**
+ * Fills blocks with signed transactions from a set of synthetic accounts.
+ *
+ * Accounts, keys and the operation sequence are all derived from the seed, so two
+ * runs with the same options against the same genesis push identical transactions.
+ * Setup (account registration, funding, and the trading asset) happens in its own
+ * blocks before the measured run starts.
+ */
+class synthetic_load
+{
+  public:
+    synthetic_load( database& db, const fc::ecc::private_key& registrar_key, const load_mix& mix,
+                    uint32_t num_accounts, uint64_t seed )
+      : _db( db ), _registrar_key( registrar_key ), _mix( mix ), _rng( seed ), _seed( seed )
+    {
+      FC_ASSERT( num_accounts >= 2, "Synthetic load needs at least 2 accounts" );
+      _keys.reserve( num_accounts );
+      for( uint32_t i = 0; i < num_accounts; ++i )
+        _keys.push_back( fc::ecc::private_key::regenerate(
+              fc::sha256::hash( "load-" + fc::to_string( _seed ) + "-" + fc::to_string( i ) ) ) );
+    }
+
+    /// Registers and funds the synthetic accounts, generating as many setup blocks as needed.
+    /// When every account already exists (a resumed run) nothing is pushed.
+    void setup()
+    {
+      const auto& by_name_idx = _db.get_index_type<account_index>().indices().get<by_name>();
+      auto registrar_itr = by_name_idx.find( "init0" );
+      FC_ASSERT( registrar_itr != by_name_idx.end(), "Synthetic load requires the init0 account from the example genesis" );
+      _registrar = registrar_itr->id;
+
+      claim_genesis_balances();
+
+      std::vector<operation> ops;
+      for( uint32_t i = 0; i < _keys.size(); ++i )
+      {
+        if( by_name_idx.find( account_name( i ) ) != by_name_idx.end() )
+          continue;
+        public_key_type key = _keys[i].get_public_key();
+        account_create_operation op;
+        op.registrar = _registrar;
+        op.referrer = _registrar;
+        op.name = account_name( i );
+        op.owner = authority( 1, key, 1 );
+        op.active = authority( 1, key, 1 );
+        op.options.memo_key = key;
+        op.options.voting_account = GRAPHENE_PROXY_TO_SELF_ACCOUNT;
+        ops.push_back( op );
+      }
+      bool already_set_up = ops.empty();
+      push_setup_operations( ops );
+
+      _accounts.reserve( _keys.size() );
+      for( uint32_t i = 0; i < _keys.size(); ++i )
+        _accounts.push_back( by_name_idx.find( account_name( i ) )->id );
+
+      if( already_set_up )
+      {
+        if( _mix.limit_order > 0 )
+        {
+          const auto& by_symbol_idx = _db.get_index_type<asset_index>().indices().get<by_symbol>();
+          auto asset_itr = by_symbol_idx.find( "LOADCOIN" );
+          FC_ASSERT( asset_itr != by_symbol_idx.end(), "Resumed database has no LOADCOIN asset for limit orders" );
+          _trading_asset = asset_itr->id;
+        }
+        return;
+      }
+
+      share_type core_per_account = _db.get_balance( _registrar, asset_id_type() ).amount / int64_t( 2 * _accounts.size() );
+      for( const account_id_type& account : _accounts )
+      {
+        transfer_operation op;
+        op.from = _registrar;
+        op.to = account;
+        op.amount = asset( core_per_account );
+        ops.push_back( op );
+      }
+      push_setup_operations( ops );
+
+      if( _mix.limit_order > 0 )
+        setup_trading_asset( core_per_account );
+    }
+
+    /// Signs and pushes @p count transactions drawn from the mix; returns how many were accepted
+    uint32_t push_transactions( uint32_t count )
+    {
+      uint32_t accepted = 0;
+      for( uint32_t i = 0; i < count; ++i )
+      {
+        size_t from;
+        signed_transaction trx;
+        trx.operations.push_back( next_operation( from ) );
+        _db.current_fee_schedule().set_fee( trx.operations.back() );
+
+        // the nonce keeps transactions with identical operations from being rejected as duplicates
+        trx.set_expiration( _db.head_block_time() + fc::seconds( 60 + ( _nonce++ % 3600 ) ) );
+        trx.set_reference_block( _db.head_block_id() );
+        trx.sign( _keys[from], _db.get_chain_id() );
+        try
+        {
+          _db.push_transaction( trx );
+          ++accepted;
+        }
+        catch( const fc::exception& e )
+        {
+          ++_rejected;
+          dlog( "synthetic transaction rejected: ${e}", ("e", e.to_string()) );
+        }
+      }
+      return accepted;
+    }
+
+    /// Advances the sequence by @p count transactions without building or pushing them,
+    /// leaving the generator where it would be after push_transactions( count )
+    void skip_transactions( uint64_t count )
+    {
+      for( uint64_t i = 0; i < count; ++i )
+      {
+        size_t from;
+        next_operation( from );
+        ++_nonce;
+      }
+    }
+
+    uint64_t rejected()const { return _rejected; }
+
+    /// Generator position as of a checkpoint. A resumed run restores it and then skips the
+    /// transactions of any blocks replayed after the checkpoint, see skip_transactions().
+    std::string state()const
+    {
+      std::ostringstream out;
+      out << _nonce << ' ' << _rng;
+      return out.str();
+    }
+
+    void restore( const std::string& saved )
+    {
+      std::istringstream in( saved );
+      in >> _nonce >> _rng;
+      FC_ASSERT( !in.fail(), "Invalid synthetic load state in checkpoint" );
+    }
+
+  private:
+    /// Draws the next operation of the sequence; @p from receives the index of the signing account
+    operation next_operation( size_t& from )
+    {
+      from = _rng() % _accounts.size();
+      size_t to = ( from + 1 + _rng() % ( _accounts.size() - 1 ) ) % _accounts.size();
+
+      uint32_t pick = _rng() % _mix.total();
+      if( pick < _mix.transfer )
+        return make_transfer( from, to );
+      else if( pick < _mix.transfer + _mix.limit_order )
+        return make_limit_order( from );
+      else
+        return make_htlc( from, to );
+    }
+
+    std::string account_name( uint32_t i )const
+    {
+      return "load-" + fc::to_string( i );
+    }
+
+    void claim_genesis_balances()
+    {
+      address owner( _registrar_key.get_public_key() );
+      std::vector<operation> ops;
+      for( const balance_object& balance : _db.get_index_type<balance_index>().indices() )
+      {
+        if( balance.owner != owner || balance.balance.asset_id != asset_id_type() )
+          continue;
+        balance_claim_operation op;
+        op.deposit_to_account = _registrar;
+        op.balance_to_claim = balance.id;
+        op.balance_owner_key = _registrar_key.get_public_key();
+        op.total_claimed = balance.balance;
+        ops.push_back( op );
+      }
+      push_setup_operations( ops );
+    }
+
+    void setup_trading_asset( share_type core_per_account )
+    {
+      const auto& by_symbol_idx = _db.get_index_type<asset_index>().indices().get<by_symbol>();
+      if( by_symbol_idx.find( "LOADCOIN" ) == by_symbol_idx.end() )
+      {
+        asset_create_operation op;
+        op.issuer = _registrar;
+        op.symbol = "LOADCOIN";
+        op.precision = 5;
+        op.common_options.max_supply = GRAPHENE_MAX_SHARE_SUPPLY;
+        op.common_options.issuer_permissions = 0;
+        op.common_options.flags = 0;
+        op.common_options.core_exchange_rate = price( asset( 1, asset_id_type(1) ), asset( 1 ) );
+        std::vector<operation> ops{ op };
+        push_setup_operations( ops );
+      }
+      _trading_asset = by_symbol_idx.find( "LOADCOIN" )->id;
+
+      std::vector<operation> ops;
+      for( const account_id_type& account : _accounts )
+      {
+        asset_issue_operation op;
+        op.issuer = _registrar;
+        op.asset_to_issue = asset( core_per_account, _trading_asset );
+        op.issue_to_account = account;
+        ops.push_back( op );
+      }
+      push_setup_operations( ops );
+    }
+
+    /// Pushes registrar-signed operations in batches and seals each batch in its own block
+    void push_setup_operations( std::vector<operation>& ops )
+    {
+      const size_t batch_size = 100;
+      for( size_t start = 0; start < ops.size(); start += batch_size )
+      {
+        signed_transaction trx;
+        for( size_t i = start; i < std::min( ops.size(), start + batch_size ); ++i )
+        {
+          trx.operations.push_back( ops[i] );
+          _db.current_fee_schedule().set_fee( trx.operations.back() );
+        }
+        trx.set_expiration( _db.head_block_time() + fc::minutes(1) );
+        trx.set_reference_block( _db.head_block_id() );
+        trx.sign( _registrar_key, _db.get_chain_id() );
+        _db.push_transaction( trx );
+        _db.generate_block( _db.get_slot_time(1), _db.get_scheduled_witness(1), _registrar_key, database::skip_nothing );
+      }
+      ops.clear();
+    }
+
+    operation make_transfer( size_t from, size_t to )
+    {
+      transfer_operation op;
+      op.from = _accounts[from];
+      op.to = _accounts[to];
+      op.amount = asset( 1 + _rng() % 1000 );
+      return op;
+    }
+
+    /// Bids sit around a 1:1 price so that a share of the orders cross and fill
+    operation make_limit_order( size_t seller )
+    {
+      share_type sell_amount = 1000 + _rng() % 1000;
+      share_type receive_amount = 1000 + _rng() % 1000;
+      bool sell_core = ( _rng() & 1 ) != 0;
+
+      limit_order_create_operation op;
+      op.seller = _accounts[seller];
+      op.amount_to_sell = asset( sell_amount, sell_core ? asset_id_type() : _trading_asset );
+      op.min_to_receive = asset( receive_amount, sell_core ? _trading_asset : asset_id_type() );
+      op.expiration = _db.head_block_time() + fc::hours(1);
+      return op;
+    }
+
+    operation make_htlc( size_t from, size_t to )
+    {
+      std::vector<char> preimage( 32 );
+      for( char& c : preimage )
+        c = static_cast<char>( _rng() );
+
+      htlc_create_operation op;
+      op.from = _accounts[from];
+      op.to = _accounts[to];
+      op.amount = asset( 1 + _rng() % 1000 );
+      op.preimage_hash = fc::sha256::hash( preimage.data(), preimage.size() );
+      op.preimage_size = preimage.size();
+      op.claim_period_seconds = 60 + _rng() % 600;
+      return op;
+    }
+
+    database&                          _db;
+    fc::ecc::private_key               _registrar_key;
+    load_mix                           _mix;
+    std::mt19937_64                    _rng;
+    uint64_t                           _seed;
+    uint64_t                           _nonce = 0;
+    uint64_t                           _rejected = 0;
+    account_id_type                    _registrar;
+    asset_id_type                      _trading_asset;
+    std::vector<fc::ecc::private_key>  _keys;
+    std::vector<account_id_type>       _accounts;
+};
+
+/// Tag at the start of a precompiled genesis image, bumped whenever the layout changes
+const uint32_t genesis_image_version = 1;
+
+/**
+ * Writes @p genesis as a binary image: version tag, sha256 of the packed state, packed size,
+ * then the fc::raw packed genesis_state_type. Loading it skips JSON parsing and the variant tree.
+ */
+void write_genesis_image( const fc::path& image_path, const genesis_state_type& genesis )
+{
+  std::vector<char> packed = fc::raw::pack( genesis );
+  fc::sha256 checksum = fc::sha256::hash( packed.data(), packed.size() );
+  uint64_t packed_size = packed.size();
+
+  std::ofstream out( image_path.preferred_string(), std::ios::binary | std::ios::trunc );
+  FC_ASSERT( out, "Unable to open ${p} for writing", ("p", image_path) );
+  fc::raw::pack( out, genesis_image_version );
+  fc::raw::pack( out, checksum );
+  fc::raw::pack( out, packed_size );
+  out.write( packed.data(), packed.size() );
+  FC_ASSERT( out, "Failed writing genesis image ${p}", ("p", image_path) );
+}
+
+genesis_state_type read_genesis_image( const fc::path& image_path )
+{
+  std::ifstream in( image_path.preferred_string(), std::ios::binary );
+  FC_ASSERT( in, "Unable to open genesis image ${p}", ("p", image_path) );
+
+  uint32_t version = 0;
+  fc::sha256 checksum;
+  uint64_t packed_size = 0;
+  fc::raw::unpack( in, version );
+  FC_ASSERT( version == genesis_image_version, "Unsupported genesis image version ${v}", ("v", version) );
+  fc::raw::unpack( in, checksum );
+  fc::raw::unpack( in, packed_size );
+  FC_ASSERT( packed_size == fc::file_size( image_path ) - uint64_t( in.tellg() ),
+             "Genesis image ${p} is truncated", ("p", image_path) );
+
+  std::vector<char> packed( packed_size );
+  in.read( packed.data(), packed.size() );
+  FC_ASSERT( in, "Failed reading genesis image ${p}", ("p", image_path) );
+  FC_ASSERT( fc::sha256::hash( packed.data(), packed.size() ) == checksum,
+             "Genesis image ${p} is corrupt (checksum mismatch)", ("p", image_path) );
+
+  return fc::raw::unpack<genesis_state_type>( packed );
+}
+
+/// Progress of the block loop as of the last checkpoint, stored next to the database
+struct checkpoint_state
+{
+  uint32_t    head_block_num = 0;
+  uint32_t    iterations = 0;
+  uint32_t    missed = 0;
+  std::string load_state;
+
+  // options that shape the block and transaction sequence, a resumed run must use the same ones
+  uint32_t    miss_rate = 0;
+  uint32_t    tx_per_block = 0;
+  load_mix    mix;
+  uint32_t    accounts = 0;
+  uint64_t    seed = 0;
+};
+
+void write_checkpoint( const fc::path& checkpoint_path, const checkpoint_state& cp )
+{
+  fc::mutable_variant_object obj;
+  obj( "head_block_num", cp.head_block_num )
+     ( "iterations", cp.iterations )
+     ( "missed", cp.missed )
+     ( "load_state", cp.load_state )
+     ( "miss_rate", cp.miss_rate )
+     ( "tx_per_block", cp.tx_per_block )
+     ( "mix_transfer", cp.mix.transfer )
+     ( "mix_limit_order", cp.mix.limit_order )
+     ( "mix_htlc", cp.mix.htlc )
+     ( "accounts", cp.accounts )
+     ( "seed", cp.seed );
+  // write-then-rename so a crash while saving leaves the previous checkpoint intact
+  fc::path tmp_path = checkpoint_path.generic_string() + ".tmp";
+  fc::json::save_to_file( fc::variant( obj, 2 ), tmp_path );
+  fc::rename( tmp_path, checkpoint_path );
+}
+
+checkpoint_state read_checkpoint( const fc::path& checkpoint_path )
+{
+  FC_ASSERT( fc::exists( checkpoint_path ), "No checkpoint found at ${p}", ("p", checkpoint_path) );
+  fc::variant_object obj = fc::json::from_file( checkpoint_path ).get_object();
+  checkpoint_state cp;
+  cp.head_block_num = obj["head_block_num"].as_uint64();
+  cp.iterations = obj["iterations"].as_uint64();
+  cp.missed = obj["missed"].as_uint64();
+  cp.load_state = obj["load_state"].as_string();
+  cp.miss_rate = obj["miss_rate"].as_uint64();
+  cp.tx_per_block = obj["tx_per_block"].as_uint64();
+  cp.mix.transfer = obj["mix_transfer"].as_uint64();
+  cp.mix.limit_order = obj["mix_limit_order"].as_uint64();
+  cp.mix.htlc = obj["mix_htlc"].as_uint64();
+  cp.accounts = obj["accounts"].as_uint64();
+  cp.seed = obj["seed"].as_uint64();
+  return cp;
+}
+
+/// Fails unless @p requested describes the same run as the checkpoint @p cp was written by
+void check_resume_options( const checkpoint_state& cp, const checkpoint_state& requested )
+{
+  FC_ASSERT( requested.miss_rate == cp.miss_rate,
+             "Cannot resume with --miss-rate ${r}, the checkpoint was written with ${c}",
+             ("r", requested.miss_rate)("c", cp.miss_rate) );
+  FC_ASSERT( requested.tx_per_block == cp.tx_per_block,
+             "Cannot resume with --tx-per-block ${r}, the checkpoint was written with ${c}",
+             ("r", requested.tx_per_block)("c", cp.tx_per_block) );
+  if( cp.tx_per_block == 0 )
+    return;
+  FC_ASSERT( requested.mix.transfer == cp.mix.transfer && requested.mix.limit_order == cp.mix.limit_order
+             && requested.mix.htlc == cp.mix.htlc,
+             "Cannot resume with a different --mix, the checkpoint was written with "
+             "transfer:${t},limit_order:${l},htlc:${h}",
+             ("t", cp.mix.transfer)("l", cp.mix.limit_order)("h", cp.mix.htlc) );
+  FC_ASSERT( requested.accounts == cp.accounts,
+             "Cannot resume with --accounts ${r}, the checkpoint was written with ${c}",
+             ("r", requested.accounts)("c", cp.accounts) );
+  FC_ASSERT( requested.seed == cp.seed,
+             "Cannot resume with --seed ${r}, the checkpoint was written with ${c}",
+             ("r", requested.seed)("c", cp.seed) );
+}
+
+/// Picks the slot for the next block from the digest of @p b, skipping slots to simulate missed blocks
+uint32_t next_slot( const signed_block& b, uint32_t miss_rate, uint32_t& missed )
+{
+  fc::sha256 h = b.digest();
+  uint64_t rand = h._hash[0].value();
+  uint32_t slot = 1;
+  while(true)
+  {
+    if( (rand % 100) < miss_rate )
+    {
+      slot++;
+      rand = (rand/100) ^ h._hash[slot&3].value();
+      missed++;
+    }
+    else
+      break;
+  }
+  return slot;
+}
+
+} // anonymous namespace
+
 int main( int argc, char** argv )
 {
   try
@@ -36,11 +598,20 @@ int main( int argc, char** argv )
     cli_options.add_options()
       ("help,h", "Print this help message and exit.")
       ("data-dir", bpo::value<boost::filesystem::path>(), "File to read genesis state from")
-      ("genesis-json,g", bpo::value<boost::filesystem::path>)
+      ("genesis-json,g", bpo::value<boost::filesystem::path>())
+      ("genesis-bin", bpo::value<boost::filesystem::path>(), "Read genesis state from a binary image written by --write-genesis-bin")
+      ("write-genesis-bin", bpo::value<boost::filesystem::path>(), "Write the genesis state as a binary image to this file and exit")
       ("genesis-time,h", bpo::value<uint32_t>()->default_value(0), "Timestamp for genesis state (0=use value from file/example)")
       ("num-blocks,n", bpo::value<uint32_t>()->default_value(1000000), "Number of blocks to generate")
       ("miss-rate,r", bpo::value<uint32_t>()->default_value(3), "Percentage of blocks to miss")
       ("verbose,v", "Enter verbose mode")
+      ("benchmark,b", "Time block production and print a JSON report to stdout")
+      ("tx-per-block", bpo::value<uint32_t>()->default_value(0), "Synthetic transactions to push before each block (0=empty blocks)")
+      ("mix", bpo::value<string>()->default_value("transfer:100"), "Synthetic operation weights, e.g. transfer:60,limit_order:30,htlc:10")
+      ("accounts", bpo::value<uint32_t>()->default_value(1000), "Number of synthetic accounts to create")
+      ("seed", bpo::value<uint64_t>()->default_value(0), "Seed for synthetic accounts and transactions")
+      ("checkpoint-every", bpo::value<uint32_t>()->default_value(0), "Write a consistent database snapshot every N blocks (0=never)")
+      ("resume", "Continue from the latest checkpoint in data-dir")
       ;
 
   bpo::variables_map options;
@@ -48,7 +619,7 @@ int main( int argc, char** argv )
   {
     boost::program_options::store( boost::program_options::parse_command_line(argc, argv, cli_options), options );
   }
-  catch (const boost::program_options:error& e)
+  catch (const boost::program_options::error& e)
   {
     std::cerr << "empty_blocks: error parsing command line: " << e.what() << "\n";
     return 1;
@@ -69,13 +640,19 @@ int main( int argc, char** argv )
   }
 
   genesis_state_type genesis;
-  if( options.count("genesis-json") )
+  if( options.count("genesis-bin") )
+  {
+    fc::path genesis_bin_filename = options["genesis-bin"].as<boost::filesystem::path>();
+    std::cerr << "embed_genesis: Reading genesis from binary image " << genesis_bin_filename.preferred_string() << "\n";
+    genesis = read_genesis_image( genesis_bin_filename );
+  }
+  else if( options.count("genesis-json") )
   {
     fc::path genesis_json_filename = options["genesis-json"].as<boost::filesystem::path>();
     std::cerr << "embed_genesis: Reading genesis from file " << genesis_json_filename.preferred_string() << "\n";
-    std::string genesis_json;
-    read_file_contents( genesis_json_filename, genesis_json );
-    genesis = fc::json::from_string( genesis_json ).as< genesis_state_type >(20);
+    // Parse straight from the file stream instead of slurping it into a string first, so
+    // only the variant tree and the resulting genesis state are alive at the peak
+    genesis = fc::json::from_file( genesis_json_filename ).as< genesis_state_type >(20);
   }
   else 
     genesis = graphene::app::detail::create_example_genesis();
@@ -87,58 +664,168 @@ int main( int argc, char** argv )
   }
   else
     std::cerr << "embed_genesis: Genesis timestamp is " << genesis.initial_timestamp.sec_since_epoch() << " (from state)\n";
+
+  if( options.count("write-genesis-bin") )
+  {
+    fc::path genesis_bin_filename = options["write-genesis-bin"].as<boost::filesystem::path>();
+    write_genesis_image( genesis_bin_filename, genesis );
+    std::cerr << "embed_genesis: Wrote binary genesis image " << genesis_bin_filename.preferred_string() << "\n";
+    return 0;
   }
-  else
-    std::cerr << "embed_genesis: Genesis timestamp is " << genesis.initial_timestamp.sec_since_epoch() << " (from state)\n";
+
   bool verbose = (options.count("verbose") != 0);
+  bool benchmark = (options.count("benchmark") != 0);
 
   uint32_t num_blocks = options["num-blocks"].as<uint32_t>();
-  uint32_t miss_rate = options["miss-rate"].as<>(uint32_t);
+  uint32_t miss_rate = options["miss-rate"].as<uint32_t>();
+  uint32_t tx_per_block = options["tx-per-block"].as<uint32_t>();
+  uint32_t checkpoint_every = options["checkpoint-every"].as<uint32_t>();
+  bool resume = (options.count("resume") != 0);
+  load_mix mix = parse_load_mix( options["mix"].as<string>() );
+  uint32_t num_accounts = options["accounts"].as<uint32_t>();
+  uint64_t seed = options["seed"].as<uint64_t>();
+
+  if( tx_per_block > 0 && mix.htlc > 0
+      && !genesis.initial_parameters.extensions.value.updatable_htlc_options.valid() )
+  {
+    htlc_options htlc_params;
+    htlc_params.max_timeout_secs = 60 * 60;
+    htlc_params.max_preimage_size = 1024;
+    genesis.initial_parameters.extensions.value.updatable_htlc_options = htlc_params;
+  }
 
   fc::ecc::private_key nathan_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("nathan")));
 
   database db;
   fc::path db_path = data_dir / "db";
-  db.open(db_path, [&]() { return genesis; }, "TEST" );
+  fc::path checkpoint_path = data_dir / "checkpoint.json";
+  checkpoint_state checkpoint;
+  checkpoint.miss_rate = miss_rate;
+  checkpoint.tx_per_block = tx_per_block;
+  checkpoint.mix = mix;
+  checkpoint.accounts = num_accounts;
+  checkpoint.seed = seed;
+  if( resume )
+  {
+    // checked before open, setup with other options would already push blocks of its own
+    checkpoint_state requested = checkpoint;
+    checkpoint = read_checkpoint( checkpoint_path );
+    check_resume_options( checkpoint, requested );
+    FC_ASSERT( fc::exists( db_path ), "Cannot resume, no database at ${p}", ("p", db_path) );
+  }
+  else
+    FC_ASSERT( !fc::exists( checkpoint_path ), "${p} exists, pass --resume or remove the data dir", ("p", checkpoint_path) );
+
+  // genesis is not needed after open, hand it over instead of copying it
+  db.open(db_path, [&]() { return std::move( genesis ); }, "TEST" );
+
+  std::unique_ptr<synthetic_load> load;
+  if( tx_per_block > 0 )
+  {
+    load.reset( new synthetic_load( db, nathan_priv_key, mix, num_accounts, seed ) );
+    std::cerr << "empty_blocks: Creating synthetic accounts\n";
+    load->setup();
+  }
 
   uint32_t slot = 1;
   uint32_t missed = 0;
+  uint32_t first_iteration = 1;
+  if( resume )
+  {
+    // open() replays any blocks logged after the snapshot; each of those was one loop iteration
+    FC_ASSERT( db.head_block_num() >= checkpoint.head_block_num );
+    uint32_t replayed = db.head_block_num() - checkpoint.head_block_num;
+    first_iteration = checkpoint.iterations + 1 + replayed;
+
+    // the checkpointed miss count already covers the slots skipped after the checkpoint block,
+    // the replayed blocks still have to add theirs
+    missed = checkpoint.missed;
+    uint32_t already_counted = 0;
+    for( uint32_t n = checkpoint.head_block_num; n <= db.head_block_num(); ++n )
+    {
+      fc::optional<signed_block> logged = db.fetch_block_by_number( n );
+      FC_ASSERT( logged.valid(), "Block #${n} is missing from the block log, the snapshot in ${p} is unusable",
+                 ("n", n)("p", data_dir) );
+      slot = next_slot( *logged, miss_rate, n == checkpoint.head_block_num ? already_counted : missed );
+    }
+
+    if( load && !checkpoint.load_state.empty() )
+    {
+      load->restore( checkpoint.load_state );
+      load->skip_transactions( uint64_t( replayed ) * tx_per_block );
+    }
+    std::cerr << "empty_blocks: Resuming at block #" << db.head_block_num() << " (iteration " << first_iteration << ")\n";
+  }
 
-  for( uint32_t i = 1; i < num_blocks; ++i )
+  std::vector<block_timing> timings;
+  if( benchmark )
+    timings.reserve( num_blocks );
+  auto run_start = std::chrono::steady_clock::now();
+  int64_t checkpoint_micros = 0;
+
+  for( uint32_t i = first_iteration; i < num_blocks; ++i )
   {
-    signed_block b = db.generate_block(db.get_slot_time(slot), db.get_scheduled_witness(slot), nathan_priv_key, database::skip_nothing);
-    FC_ASSERT( db.head_block_id() == b.id() );
-    fc::sha256 h = b.digest();
-    uint64_t rand = h._hash[0].value();
-    slot = 1;
-    while(true)
+    fc::time_point_sec slot_time = db.get_slot_time(slot);
+    bool maintenance = ( db.get_dynamic_global_properties().next_maintenance_time <= slot_time );
+    block_timing t;
+    if( load )
     {
-      if( (rand % 100) < miss_rate )
-      {
-        slot++;
-	rand = (rand/100) ^ h._hash[slot&3].value();
-	missed++;
-      }
-      else
-        break;
+      auto push_start = std::chrono::steady_clock::now();
+      t.transactions = load->push_transactions( tx_per_block );
+      t.push_micros = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - push_start ).count();
     }
+    auto block_start = std::chrono::steady_clock::now();
+    signed_block b = db.generate_block(slot_time, db.get_scheduled_witness(slot), nathan_priv_key, database::skip_nothing);
+    if( benchmark )
+    {
+      t.micros = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - block_start ).count();
+      t.maintenance = maintenance;
+      timings.push_back( t );
+    }
+    FC_ASSERT( db.head_block_id() == b.id() );
+    slot = next_slot( b, miss_rate, missed );
 
     witness_id_type prev_witness = b.witness;
     witness_id_type cur_witness = db.get_scheduled_witness(1);
     if( verbose )
     {
-    
+      wdump( (prev_witness)(cur_witness) );
     }
-    else if()
+    else if( (i%10000) == 0 )
     {
-    
+      std::cerr << "\rblock #" << i << "   missed " << missed;
     }
     if ( slot == 1 ) 
     {
       FC_ASSERT( cur_witness != prev_witness );
     }
+
+    if( checkpoint_every > 0 && (i % checkpoint_every) == 0 )
+    {
+      // drop pending transactions so the flushed objects are exactly the state at the head
+      // block; flush() also writes out the block log, so the checkpoint block is on disk
+      // before the checkpoint names it. The database stays open and the loop continues.
+      auto checkpoint_start = std::chrono::steady_clock::now();
+      db.clear_pending();
+      db.flush();
+      checkpoint.head_block_num = db.head_block_num();
+      checkpoint.iterations = i;
+      checkpoint.missed = missed;
+      checkpoint.load_state = load ? load->state() : std::string();
+      write_checkpoint( checkpoint_path, checkpoint );
+      checkpoint_micros += std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - checkpoint_start ).count();
+    }
   }
   std::cerr << "\n";
+
+  if( benchmark )
+  {
+    // checkpoint writes are reported on their own so they do not skew blocks/sec
+    int64_t wall_micros = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - run_start ).count()
+                          - checkpoint_micros;
+    print_benchmark_report( timings, wall_micros, checkpoint_micros, missed, load ? load->rejected() : 0 );
+  }
+
   db.close();
 }
 catch ( const fc::exception& e )
@@ -149,3 +836,4 @@ catch ( const fc::exception& e )
 return 0;
 
 
+}
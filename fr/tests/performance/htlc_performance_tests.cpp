@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <fc/crypto/sha256.hpp>
+
+#include <graphene/chain/htlc_object.hpp>
+#include <graphene/protocol/htlc.hpp>
+
+#include "../common/database_fixture.hpp"
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+BOOST_FIXTURE_TEST_SUITE( htlc_performance_tests, database_fixture )
+
+/**
+ * Block production cost while a growing number of HTLCs is open.
+ *
+ * The per-block expiry sweep only walks HTLCs that are due, so the time for a block
+ * in which nothing expires should stay flat as the open count grows, and a block in
+ * which a batch expires should cost in proportion to the batch, not to the open count.
+ */
+BOOST_AUTO_TEST_CASE( htlc_expiry_sweep_benchmark )
+{
+try {
+  ACTORS((alice)(bob));
+
+  transfer( committee_account, alice_id, graphene::chain::asset( 1000000 * GRAPHENE_BLOCKCHAIN_PRECISION ) );
+
+  generate_blocks( HARDFORK_CORE_1468_TIME );
+  set_expiration( db, trx );
+  set_htlc_committee_parameters();
+  generate_block();
+  set_expiration( db, trx );
+  trx.clear();
+
+  const uint32_t block_interval = db.get_global_properties().parameters.block_interval;
+  uint32_t next_preimage = 0;
+
+  // pushes count HTLCs, ops_per_trx to a transaction, and seals a block after every
+  // trx_per_block transactions; everything sealed in one block shares one expiration
+  auto open_htlcs = [&]( uint32_t count, uint32_t claim_period_seconds, uint32_t trx_per_block )
+  {
+    const uint32_t ops_per_trx = 100;
+    uint32_t pushed_trx = 0;
+    for( uint32_t created = 0; created < count; created += ops_per_trx )
+    {
+      for( uint32_t i = created; i < std::min( count, created + ops_per_trx ); ++i )
+      {
+        std::string pre_image = std::to_string( next_preimage++ );
+        graphene::chain::htlc_create_operation create_operation;
+        create_operation.amount = graphene::chain::asset( 1 );
+        create_operation.to = bob_id;
+        create_operation.claim_period_seconds = claim_period_seconds;
+        create_operation.preimage_hash = fc::sha256::hash( pre_image );
+        create_operation.preimage_size = pre_image.size();
+        create_operation.from = alice_id;
+        create_operation.fee = db.current_fee_schedule().calculate_fee( create_operation );
+        trx.operations.push_back( create_operation );
+      }
+      sign( trx, alice_private_key );
+      PUSH_TX( db, trx, ~0 );
+      trx.clear();
+      if( ++pushed_trx % trx_per_block == 0 )
+      {
+        generate_block();
+        set_expiration( db, trx );
+      }
+    }
+    if( pushed_trx % trx_per_block != 0 )
+    {
+      generate_block();
+      set_expiration( db, trx );
+    }
+  };
+
+  auto micros_per_block = [&]( uint32_t num_blocks ) -> int64_t
+  {
+    fc::time_point start = fc::time_point::now();
+    for( uint32_t i = 0; i < num_blocks; ++i )
+      generate_block();
+    set_expiration( db, trx );
+    return ( fc::time_point::now() - start ).count() / num_blocks;
+  };
+
+  // a day keeps all of these open for the whole run
+  const uint32_t long_claim_period = 24 * 60 * 60;
+  uint32_t open_count = 0;
+  for( uint32_t target : { 1000u, 10000u, 50000u } )
+  {
+    open_htlcs( target - open_count, long_claim_period, 1 );
+    open_count = target;
+    int64_t us = micros_per_block( 100 );
+    wlog( "HTLC sweep benchmark: ${n} open, none due: ${us} us/block", ("n", open_count)("us", us) );
+  }
+
+  // the whole batch goes into a single block so it shares one expiration and is swept at once
+  const uint32_t batch = 1000;
+  const uint32_t short_claim_period = 60;
+  open_htlcs( batch, short_claim_period, batch );
+  const auto& htlc_idx = db.get_index_type<htlc_index>().indices();
+  BOOST_REQUIRE_EQUAL( htlc_idx.size(), open_count + batch );
+  fc::time_point_sec batch_expiration = htlc_idx.rbegin()->conditions.time_lock.expiration;
+
+  // produce every block up to the one before the batch falls due, then time the sweeping block alone
+  generate_blocks( batch_expiration - block_interval, false );
+  BOOST_REQUIRE_EQUAL( htlc_idx.size(), open_count + batch );
+  int64_t us = micros_per_block( 1 );
+  BOOST_CHECK( db.head_block_time() >= batch_expiration );
+  BOOST_CHECK_EQUAL( htlc_idx.size(), open_count );
+  wlog( "HTLC sweep benchmark: ${n} open, ${b} expiring: ${us} us/block",
+        ("n", open_count + batch)("b", batch)("us", us) );
+} FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
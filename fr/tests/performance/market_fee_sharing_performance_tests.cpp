@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/market_object.hpp>
+
+#include "../common/database_fixture.hpp"
+#include "../common/reward_database_fixture.hpp"
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+/**
+ * Fills an order book with resting sell orders and then crosses it one fill at a time,
+ * so the cost of market fee sharing on the matching path can be compared with plain fills.
+ */
+struct matching_benchmark_fixture : reward_database_fixture
+{
+  /// Builds an unsigned limit order transaction; create_sell_order and PUSH_TX would also scan every
+  /// balance and order through verify_asset_supplies on each call, which swamps the matching cost
+  signed_transaction make_limit_order( account_id_type seller, const asset& amount_to_sell, const asset& min_to_receive )
+  {
+    limit_order_create_operation op;
+    op.seller = seller;
+    op.amount_to_sell = amount_to_sell;
+    op.min_to_receive = min_to_receive;
+    op.expiration = fc::time_point_sec::maximum();
+
+    signed_transaction tx;
+    tx.operations.push_back( op );
+    db.current_fee_schedule().set_fee( tx.operations.back() );
+    set_expiration( db, tx );
+    return tx;
+  }
+
+  void run_matching_benchmark( const std::string& label, uint16_t reward_percent, bool whitelist_registrar = false )
+  {
+    const uint32_t resting_orders = 10000;
+    const uint32_t fills = 2000;
+
+    ACTORS((jill)(izzyregistrar)(izzyreferrer));
+
+    upgrade_to_lifetime_member(izzyregistrar);
+    upgrade_to_lifetime_member(izzyreferrer);
+
+    price price(asset(1, asset_id_type(1)), asset(1));
+    uint16_t market_fee_percent = 20 * GRAPHENE_1_PERCENT;
+    const asset_object jillcoin = create_user_issued_asset( "JCOIN", jill, charge_market_fee, price, 2, market_fee_percent );
+    asset_id_type jillcoin_id = jillcoin.get_id();
+
+    const account_object alice = create_account("alice", izzyregistrar, izzyreferrer, 50 );
+    const account_object bob = create_account("bob", izzyregistrar, izzyreferrer, 50 );
+    account_id_type alice_id = alice.get_id();
+    account_id_type bob_id = bob.get_id();
+
+    issue_uia( alice, jillcoin.amount( int64_t( resting_orders ) * 1000 ) );
+    transfer( committee_account, alice_id, core_asset(1000000) );
+    transfer( committee_account, bob_id, core_asset(1000000) );
+
+    generate_blocks_past_hf1268();
+    if( reward_percent > 0 )
+    {
+      // a whitelist that admits the registrar forces the lookup on every fill
+      whitelist_market_fee_sharing_t whitelist;
+      if( whitelist_registrar )
+        whitelist = flat_set<account_id_type>{ izzyregistrar_id };
+      update_asset( jill_id, jill_private_key, jillcoin_id, reward_percent, whitelist );
+    }
+    generate_block();
+
+    // alice asks 1000 JCOIN for 1000+i core, so the cheapest ask is always the next one to fill
+    for( uint32_t i = 0; i < resting_orders; ++i )
+    {
+      signed_transaction ask = make_limit_order( alice_id, asset( 1000, jillcoin_id ), asset( 1000 + i ) );
+      db.push_transaction( precomputable_transaction( ask ), database::skip_transaction_signatures );
+      if( (i % 100) == 99 )
+        generate_block();
+    }
+    generate_block();
+    verify_asset_supplies( db );
+
+    // Fills run in batches of one block. Each batch is built up front, then its pushes run
+    // back to back in one wall clock window; generate_block, which re-applies the pending
+    // orders, runs between the windows.
+    const uint32_t fills_per_block = 100;
+    std::vector<int64_t> fill_micros;
+    fill_micros.reserve( fills );
+    int64_t elapsed = 0;
+    for( uint32_t first = 0; first < fills; first += fills_per_block )
+    {
+      uint32_t last = std::min( first + fills_per_block, fills );
+      std::vector<precomputable_transaction> batch;
+      batch.reserve( last - first );
+      for( uint32_t i = first; i < last; ++i )
+        batch.emplace_back( make_limit_order( bob_id, asset( 1000 + i ), asset( 1000, jillcoin_id ) ) );
+
+      fc::time_point window_start = fc::time_point::now();
+      fc::time_point fill_start = window_start;
+      for( const precomputable_transaction& fill_tx : batch )
+      {
+        db.push_transaction( fill_tx, database::skip_transaction_signatures );
+        fc::time_point fill_end = fc::time_point::now();
+        fill_micros.push_back( ( fill_end - fill_start ).count() );
+        fill_start = fill_end;
+      }
+      elapsed += ( fill_start - window_start ).count();
+      generate_block();
+    }
+    verify_asset_supplies( db );
+
+    BOOST_CHECK_EQUAL( db.get_index_type<limit_order_index>().indices().size(), resting_orders - fills );
+
+    std::sort( fill_micros.begin(), fill_micros.end() );
+    wlog( "Matching benchmark (${l}): ${n} fills against ${r} resting orders, ${fps} fills/s, "
+          "p50 ${p50} us, p99 ${p99} us, max ${max} us",
+          ("l", label)("n", fills)("r", resting_orders)
+          ("fps", elapsed > 0 ? int64_t( fills ) * 1000000 / elapsed : 0)
+          ("p50", fill_micros[ fill_micros.size() / 2 ])
+          ("p99", fill_micros[ ( fill_micros.size() * 99 ) / 100 ])
+          ("max", fill_micros.back()) );
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE( market_fee_sharing_performance_tests, matching_benchmark_fixture )
+
+BOOST_AUTO_TEST_CASE( matching_without_fee_sharing )
+{
+  try
+  {
+    run_matching_benchmark( "no fee sharing", 0 );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( matching_with_fee_sharing )
+{
+  try
+  {
+    run_matching_benchmark( "fee sharing", 20 * GRAPHENE_1_PERCENT );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( matching_with_fee_sharing_whitelist )
+{
+  try
+  {
+    run_matching_benchmark( "fee sharing with whitelist", 20 * GRAPHENE_1_PERCENT, true );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -269,6 +269,74 @@ try {
 } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( htlc_expiry_sweep )
+{
+try {
+  ACTORS((alice)(bob));
+
+  int64_t init_balance(100 * GRAPHENE_BLOCKCHAIN_PRECISION);
+
+  transfer( committee_account, alice_id, graphene::chain::asset(init_balance) );
+
+  advance_past_hardfork(this);
+
+  uint16_t preimage_size = 256;
+  std::vector<char> pre_image(256);
+  generate_random_preimage(preimage_size, pre_image);
+
+  generate_block();
+  trx.clear();
+
+  // staggered claim periods, so each HTLC falls due in a different block
+  std::vector<uint32_t> claim_periods = { 60, 120, 180 };
+  std::vector<graphene::chain::htlc_id_type> htlc_ids;
+  for( uint32_t claim_period : claim_periods )
+  {
+    graphene::chain::htlc_create_operation create_operation;
+    create_operation.amount = graphene::chain::asset( 1 * GRAPHENE_BLOCKCHAIN_PRECISION );
+    create_operation.to = bob_id;
+    create_operation.claim_period_seconds = claim_period;
+    create_operation.preimage_hash = hash_it<fc::sha256>( pre_image );
+    create_operation.preimage_size = preimage_size;
+    create_operation.from = alice_id;
+    create_operation.fee = db.current_fee_schedule().calculate_fee( create_operation );
+    trx.operations.push_back( create_operation );
+    sign(trx, alice_private_key);
+    PUSH_TX(db, trx, ~0);
+    trx.clear();
+    graphene::chain::signed_block blk = generate_block();
+    processed_transaction alice_trx = blk.transactions[0];
+    htlc_ids.push_back( alice_trx.operation_results[0].get<object_id_type>() );
+    set_expiration( db, trx );
+  }
+
+  const fc::time_point_sec start = db.head_block_time();
+  const uint32_t block_interval = db.get_global_properties().parameters.block_interval;
+  for( size_t due = 0; due < htlc_ids.size(); ++due )
+  {
+    const graphene::chain::htlc_object& htlc = htlc_ids[due](db);
+    fc::time_point_sec expiration = htlc.conditions.time_lock.expiration;
+    BOOST_CHECK( expiration > start );
+
+    // produce every block up to the one before expiration, none of them may sweep it or anything later
+    generate_blocks( expiration - block_interval, false );
+    for( size_t i = due; i < htlc_ids.size(); ++i )
+      BOOST_CHECK( db.find( htlc_ids[i] ) != nullptr );
+    int64_t balance_before = get_balance( alice_id, graphene::chain::asset_id_type() );
+
+    // the very next block is the one where it falls due and alice gets her coin back
+    generate_block();
+    BOOST_CHECK( db.head_block_time() >= expiration );
+    for( size_t i = 0; i <= due; ++i )
+      BOOST_CHECK( db.find( htlc_ids[i] ) == nullptr );
+    for( size_t i = due + 1; i < htlc_ids.size(); ++i )
+      BOOST_CHECK( db.find( htlc_ids[i] ) != nullptr );
+    BOOST_CHECK_EQUAL( get_balance( alice_id, graphene::chain::asset_id_type() ),
+                       balance_before + 1 * GRAPHENE_BLOCKCHAIN_PRECISION );
+  }
+} FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_CASE( htlc_hardfork_test )
 {
   try {
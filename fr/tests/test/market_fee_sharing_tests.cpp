@@ -7,6 +7,7 @@
 #include <>
 
 #include "../common/database_fixture.hpp"
+#include "../common/reward_database_fixture.hpp"
 
 using namespace graphene::chain;
 using namespace graphene::chain::test;
@@ -21,116 +22,6 @@ namespace fc
   }
 }
 
-struct reward_database_fixture : database_fixture
-{
-  using whitelist_market_fee_sharing_t = fc::optional<flat_set<account_id_type>>;
-
-  reward_database_fixture()
-    : database_fixture(HARDFORK_1268_TIME - 100)
-  {
-  }
-
-  void update_asset( const account_id_type& issuer_id,
-		     const fc::ecc::private_key& private_key,
-		     const asset_id_type& asset_id,
-		     uint16_t reward_percent,
-		     const whitelist_market_fee_sharing_t &whitelist_market_fee_sharing = whitelist_market_fee_sharing_t{},
-		     const flat_set<account_id_type> &blacklist = flat_set<account_id_type>())
-  {
-    asset_update_operation op;
-    op.issuer = issuer_id;
-    op.asset_to_update = asset_id;
-    op.new_options = asset_id(db).options;
-    op.new_options.extensions.value.reward_percent = reward_percent;
-    op.new_options.extensions.value.whitelist_market_fee_sharing = whitelist_market_fee_sharing;
-    op.new_options.blacklist_authorities = blacklist;
-
-    signed_transaction tx;
-    tx.operations.push_back( op );
-    db.current_fee_schedule().set_fee( tx.operations.back() );
-    set_expiration( db, tx );
-    set_expiration( db, tx );
-    sign( tx, private_key );
-    PUSH_TX( db, tx );
-  }
-
-  void asset_update_blacklist_authority(const account_id_type& issuer_id,
-		  			const asset_id_type& asset_id,
-					const account_id_type& authority_account_id,
-					const fc::ecc::private_key& issuer_private_key)
-  {
-    asset_update_operation uop;
-    uop.issuer = issuer_id;
-    uop.asset_to_update = asset_id;
-    uop.new_options = asset_id(db).options;
-    uop.new_options.blacklist_authorities.insert(authority_account_id);
-
-    signed_transaction tx;
-    tx.operations.push_back( uop );
-    db.current_fee_schedule().set_fee( tx.operations.back() );
-    set_expiration( db, tx );
-    sign( tx, issuer_private_key );
-    PUSH_TX( db, tx );
-  }
-
-  void add_update_blacklist_authority(const account_id_type& issuer_id,
-		  		      const asset_id_type& asset_id,
-				      const account_id_type& authority_account_id,
-				      const fc::ecc::private_key& issuer_private_key)
-  {
-    asset_update_operation uop;
-    uop.issuer = issuer_id;
-    uop.asset_to_update = asset_id;
-    uop.new_options = asset_id(db).options;
-    uop.new_options.blacklist_authorities.insert(authority_account_id);
-
-    signed_transaction tx;
-    tx.operations.push_back( uop );
-    db.current_fee_schedule().set_fee( tx.operations.back() );
-    set_expiration( db, tx );
-    sign( tx, issuer_private_key );
-    PUSH_TX( db, tx );
-  }
-
-  void add_account_to_blacklist(const account_id_type& authorizing_account_id,
-		  		const account_id_type& blacklisted_account_id,
-				const fc::ecc::private_key& authorizing_account_private_key)
-  {
-    account_whitelist_operation wop;
-    wop.authorizing_account = authorizing_account_id;
-    wop.account_to_list = blacklisted_account_id;
-    wop.new_listing = account_whitelist_operation::black_listed;
-
-    signed_transaction tx;
-    tx.operations.push_back( wop );
-    db.current_fee_schedule().set_fee( tx.operations.back() );
-    set_expiration( db, tx );
-    sign( tx, authorizing_account_private_key );
-    PUSH_TX( db, tx );
-  }
-
-  void generate_blocks_past_hf1268()
-  {
-    database_fixture::generate_blocks( HARDFORK_1268_TIME );
-    database_fixture::generate_block();
-  }
-
-  asset core_asset(int64_t x )
-  {
-    return asset( x*core_precision );
-  };
-
-  const share_type core_precision = asset::scaled_precision( asset_id_type()(db).precision );
-
-  void create_vesting_balance_object(const account_id_type& account_id, vesting_balance_object &vbo) 
-  {
-    db.create<vesting_balance_object>([&account_id, balance_type] (vesting_balance_object &vbo) {
-      vbo.owner = account_id;
-      vbo.balance_type = balance_type;
-    });
-  };
-};
-
 BOOST_FIXTURE_TEST_SUITE( fee_sharing_tests, reward_database_fixture )
 {
   try